@@ -64,7 +64,8 @@ struct indicator_mode_t {
     uint8_t off_count;
 };
 
-const indicator_mode_t c_indicator_modes[] = {
+/* Таблицы констант храним во флеш-памяти, чтобы не занимать ими ОЗУ */
+const indicator_mode_t c_indicator_modes[] PROGMEM = {
     {4, 1, 4, 1}, /*  0 -  0.0% */
     {1, 1, 5, 1}, /*  1 -  0.8% */
     {1, 1, 4, 1}, /*  2 -  1.5% */
@@ -87,7 +88,7 @@ const uint8_t c_max_brightness =
     sizeof(c_indicator_modes) / sizeof(*c_indicator_modes) - 1;
 
 /* Массив изображений цифр для индикатора */
-const uint8_t c_digits0_9[10] = {
+const uint8_t c_digits0_9[10] PROGMEM = {
     DIGIT_0, DIGIT_1, DIGIT_2, DIGIT_3, DIGIT_4,
     DIGIT_5, DIGIT_6, DIGIT_7, DIGIT_8, DIGIT_9};
 
@@ -134,7 +135,8 @@ void indicator_t::timer_processing()
 {
     if (--repeat_counter_) return;
 
-    const indicator_mode_t &mode = c_indicator_modes[brightness_];
+    indicator_mode_t mode;
+    memcpy_P(&mode, &c_indicator_modes[brightness_], sizeof(mode));
 
     /* Отключаем индикаторы (катоды к питанию) */
     PORTC |= 0b00111100;
@@ -213,7 +215,7 @@ bool indicator_t::memprint_fix(
         }
         /* Выводим числа поразрядно. Вместо ведущих нулей - пробелы */
         else {
-            uint8_t n = (num > 0 || i >= dig_with_dp ? c_digits0_9[num % 10] : space);
+            uint8_t n = (num > 0 || i >= dig_with_dp ? pgm_read_byte(&c_digits0_9[num % 10]) : space);
             if (decimals != 0 && i == dig_with_dp) n |= SIGN_DP; /* Точка */
             mem[i - 1] = n;
         }
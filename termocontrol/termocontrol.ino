@@ -47,24 +47,32 @@
 #define EEPROM_CONTROL_TEMP_L   17
 #define EEPROM_CONTROL_TEMP_H   18
 
+/* Температура ещё не получена от датчика */
+#define TEMP_UNKNOWN            (-32767 - 1)
+
+/* Минимальная скорость изменения температуры для индикации тренда,
+   сотые доли градуса в минуту */
+#define TREND_SHOW              10
+
 #include <OneWire.h>
 #include <LowPower.h>
 #include "termocontrol.h"
 #include "indicator.h"
+#include "trend.h"
 
 indicator_t g_indicator;
 mode_t g_mode = SENSOR1; /* Режим индикации */
 mode_t g_last_sensor; /* Для возврата из SETCONTROL И ONOFF */
 uint8_t g_errno; /* Ошибка */
-
-uint8_t g_screens[5][4]; /* Экраны */
-uint8_t g_screens_brightness[5];
-mode_t g_active_screen = g_mode;
-uint8_t g_goto_active_screen_steps = 0;
+bool g_screen_invalid = true; /* Флаг необходимости перерисовать
+                                 текущий экран на индикаторе */
 
 OneWire g_sensors(7); /* Порт D7 на Arduino = D7 на Atmega328p */
 uint8_t g_sensors_addr[2][8]; /* Адреса датчиков */
-int g_sensors_temp[2];
+int g_sensors_temp[2] = {TEMP_UNKNOWN, TEMP_UNKNOWN};
+trend_t g_sensors_trend[2]; /* Тренды температуры */
+unsigned long g_trend_timestamp; /* Метка времени последнего отсчёта
+                                    для трендов */
 
 mode_t g_control_sensor = NOTHING; /* Номер датчика с контролем
     температуры (255 - не определён) */
@@ -145,6 +153,7 @@ void delay750()
     g_indicator.print(EMPTY, EMPTY, EMPTY, SIGN_DP);
     delay(190);
     g_indicator.clear();
+    g_screen_invalid = true;
 }
 
 /***********************************************************************
@@ -189,52 +198,123 @@ void update_temp(mode_t sensor)
     int temp = (ti >> 4) * 10 + td;
     if (negative) temp = -temp;
 
-    g_sensors_temp[sensor] = temp;
-    update_screen(sensor);
+    if (g_sensors_temp[sensor] != temp) {
+        g_sensors_temp[sensor] = temp;
+        if (g_mode == sensor) g_screen_invalid = true;
+    }
+}
+
+/***********************************************************************
+ *  Добавление отсчётов в тренды
+ */
+void update_trends()
+{
+    for (int i = SENSOR1; i <= SENSOR2; i++) {
+        if (g_sensors_temp[i] != TEMP_UNKNOWN)
+            g_sensors_trend[i].add(g_sensors_temp[i]);
+    }
+
+    if (g_mode == SENSOR1 || g_mode == SENSOR2)
+        g_screen_invalid = true;
+}
+
+/***********************************************************************
+ *  Направление тренда для индикации: 1 - рост, -1 - падение, 0 - нет
+ */
+int8_t trend_direction(mode_t sensor)
+{
+    const trend_t &trend = g_sensors_trend[sensor];
+
+    if (!trend.ready())
+        return 0;
+
+    int16_t slope = trend.slope();
+    return slope >= TREND_SHOW ? 1 : slope <= -TREND_SHOW ? -1 : 0;
 }
 
 /***********************************************************************
- *  Обновление экранов
+ *  Формирование экрана по текущему состоянию (экраны не хранятся
+ *  в памяти, а отрисовываются непосредственно перед выводом)
+ *  screen - экран;
+ *  mem - буфер для изображения (4 знака).
  */
-void update_screen(mode_t screen)
+void render_screen(mode_t screen, uint8_t *mem)
 {
     switch (screen) {
     case SENSOR1:
     case SENSOR2:
-        g_screens_brightness[screen] = 15; /* TODO: здесь не нужно! */
-        g_indicator.memprint_fix(
-            g_screens[screen], g_sensors_temp[screen], 1);
+        if (g_sensors_temp[screen] == TEMP_UNKNOWN)
+            indicator_t::memprint(
+                mem, EMPTY, EMPTY, SIGN_MINUS | SIGN_DP, SIGN_MINUS);
+        else {
+            /*  Тренд показываем в первом знакоместе, если температура
+                помещается в остальные три */
+            int8_t dir = trend_direction(screen);
+            if (dir != 0 && indicator_t::memprint_fix(
+                    mem, g_sensors_temp[screen], 1, DIG2, DIG4))
+                indicator_t::memprint(
+                    mem, dir > 0 ? SIGN_HIGH : SIGN_LOW, DIG1);
+            else
+                indicator_t::memprint_fix(mem, g_sensors_temp[screen], 1);
+        }
         break;
-    
-    case SETCONTROL:
-        g_screens_brightness[SETCONTROL] = g_control_actived ? 15 : 4;
-        indicator_t::memprint_fix(
-            g_screens[SETCONTROL], g_control_temp, 1);
 
+    case MESSAGE:
+        indicator_t::memprint_int(mem, g_errno);
+        indicator_t::memprint(mem, CHAR_E, g_errno < 10 ? DIG3 : DIG2);
         break;
-    
+
+    case SETCONTROL:
+        indicator_t::memprint_fix(mem, g_control_temp, 1);
+        break;
+
     case ONOFF:
-        if (!g_control_actived) {
-            g_screens_brightness[ONOFF] = 4;
-            indicator_t::memprint(
-                g_screens[ONOFF], EMPTY, CHAR_o, CHAR_F, CHAR_F);
-        }
-        else {
-            g_screens_brightness[ONOFF] = 15;
-            indicator_t::memprint(
-                g_screens[ONOFF], EMPTY, CHAR_o, CHAR_n, EMPTY);
-        }
+        if (!g_control_actived)
+            indicator_t::memprint(mem, EMPTY, CHAR_o, CHAR_F, CHAR_F);
+        else
+            indicator_t::memprint(mem, EMPTY, CHAR_o, CHAR_n, EMPTY);
         break;
+
+    default:
+        indicator_t::memprint(mem, EMPTY, EMPTY, EMPTY, EMPTY);
     }
 }
 
 /***********************************************************************
- *  Обновление индикатора при измении экранов
+ *  Яркость экрана по текущему состоянию
+ */
+int8_t screen_brightness(mode_t screen)
+{
+    switch (screen) {
+    case SENSOR1:
+    case SENSOR2:
+        /* В режиме контроля температуры экраны датчиков "дышат" */
+        if (g_control_actived)
+            return g_blink_step <= 15 ? 15 - g_blink_step : g_blink_step - 15;
+        return 15;
+
+    case SETCONTROL:
+    case ONOFF:
+        return g_control_actived ? 15 : 4;
+
+    default:
+        return 15;
+    }
+}
+
+/***********************************************************************
+ *  Обновление индикатора. Экран перерисовывается только при изменении
  */
 void update_indicator()
 {
-    g_indicator.set_brightness( g_screens_brightness[g_mode]);
-    g_indicator.print( g_screens[g_mode]);
+    g_indicator.set_brightness( screen_brightness(g_mode));
+
+    if (g_screen_invalid) {
+        uint8_t mem[4];
+        render_screen(g_mode, mem);
+        g_indicator.print(mem);
+        g_screen_invalid = false;
+    }
 }
 
 /***********************************************************************
@@ -362,14 +442,14 @@ uint8_t test_buttons(uint8_t *p_ctrl_state)
 }
 
 /***********************************************************************
- * Сравнение данных
+ * Сравнение данных с данными в EEPROM (без копирования в ОЗУ)
  */
-bool cmp(void *dat1, void *dat2, unsigned int len)
+bool cmp_EEPROM(uint16_t addr, const uint8_t *dat, unsigned int len)
 {
     bool res = true;
     
     for (unsigned int i = 0; i < len; i++) {
-        if ( ((uint8_t*)dat1)[i] != ((uint8_t*)dat2)[i]) {
+        if (EEPROM_read(addr + i) != dat[i]) {
             res = false;
             break;
         }
@@ -396,6 +476,9 @@ void swap(void *dat1, void *dat2, unsigned int len)
 void swap_sensors()
 {
     swap( g_sensors_addr[0], g_sensors_addr[1], 8);
+    swap( &g_sensors_temp[0], &g_sensors_temp[1], sizeof(*g_sensors_temp));
+    swap( &g_sensors_trend[0], &g_sensors_trend[1], sizeof(*g_sensors_trend));
+    g_screen_invalid = true;
           
     for (int i = 0; i < 16; i++) {
         EEPROM_write( EEPROM_SENSORSID + i, g_sensors_addr[0][i]);
@@ -453,11 +536,13 @@ void change_mode(mode_t new_mode)
             break;
         } /* switch (new_mode) */
     
+        uint8_t mem[4];
+        render_screen(new_mode, mem);
         g_indicator.anim(
-            g_screens[new_mode], anim_type, 100,
-            g_screens_brightness[new_mode]);
+            mem, anim_type, 100, screen_brightness(new_mode));
 
         g_mode = new_mode;
+        g_screen_invalid = false;
     } /* if (new_mode != g_mode) */
 }
 
@@ -466,10 +551,15 @@ void change_mode(mode_t new_mode)
  */
 void clear_control_sensor()
 {
+    /* Без датчика контролировать температуру нечем */
+    HEATER_OFF();
+    g_control_actived = false;
+
     g_control_sensor = NOTHING;
     EEPROM_write( EEPROM_CONTROL_SENSOR, g_control_sensor);
     g_indicator.print( EMPTY, EMPTY, EMPTY, SIGN_MINUS);
     delay(200);
+    g_screen_invalid = true;
 }
 
 /***********************************************************************
@@ -481,6 +571,7 @@ void set_control_sensor(mode_t control_sensor)
     EEPROM_write( EEPROM_CONTROL_SENSOR, g_control_sensor);
     g_indicator.clear(); /* Моргаем */
     delay(200);
+    g_screen_invalid = true;
 }
 
 /***********************************************************************
@@ -488,11 +579,8 @@ void set_control_sensor(mode_t control_sensor)
  */
 void error(uint8_t errno)
 {
-    indicator_t::memprint_int(
-        g_screens[MESSAGE], errno);
-    indicator_t::memprint(
-        g_screens[MESSAGE], CHAR_E, errno < 10 ? DIG3 : DIG2);
-    
+    g_errno = errno;
+    g_screen_invalid = true;
     change_mode(MESSAGE);
 }
     
@@ -553,33 +641,12 @@ void setup()
         | (1 << PCINT18) | (1 << PCINT19);
 
 
-    /***
-     * Инициализируем экраны
-     */
-    
-    indicator_t::memprint(
-        g_screens[SENSOR1],
-        EMPTY, EMPTY, SIGN_MINUS | SIGN_DP, SIGN_MINUS);
-    g_screens_brightness[SENSOR1] = 15;
-    
-    indicator_t::memprint(
-        g_screens[SENSOR2],
-        EMPTY, EMPTY, SIGN_MINUS | SIGN_DP, SIGN_MINUS);
-    g_screens_brightness[SENSOR2] = 15;
-    
-    indicator_t::memprint(
-        g_screens[MESSAGE],
-        EMPTY, EMPTY, EMPTY, EMPTY);
-    g_screens_brightness[MESSAGE] = 15;
-
     /* Загружаем последнюю используемую температуру для контроля */
     uint8_t tl = EEPROM_read( EEPROM_CONTROL_TEMP_L);
     uint8_t th = EEPROM_read( EEPROM_CONTROL_TEMP_H);
     if (tl != 0xFF || th != 0xFF)
         g_control_temp = tl | (th << 8);
 
-    update_screen(SETCONTROL);
-    update_screen(ONOFF);
     
     /***
      * Разбираемся с датчиками
@@ -596,19 +663,15 @@ void setup()
             До первой записи == 255 (NOTHING) */
         g_control_sensor = (mode_t)EEPROM_read( EEPROM_CONTROL_SENSOR);
 
-        /*  Загружаем из EEPROM идентификаторы датчиков для сравнения
-            и установки порядка */
-        uint8_t addr[2][8];
-        for (int i = 0; i < 16; i++)
-            addr[0][i] = EEPROM_read( EEPROM_SENSORSID + i);
-
-        if ( cmp(addr[0], g_sensors_addr[0], 8)
-                && cmp(addr[1], g_sensors_addr[1], 8)) {
+        /*  Сравниваем идентификаторы датчиков с сохранёнными в EEPROM
+            для установки порядка */
+        if ( cmp_EEPROM(EEPROM_SENSORSID, g_sensors_addr[0], 8)
+                && cmp_EEPROM(EEPROM_SENSORSID + 8, g_sensors_addr[1], 8)) {
             /*  Идентификаторы датчиков соответствуют сохранённым.
                 Порядок - нормальный */
         }
-        else if (cmp(addr[0], g_sensors_addr[1], 8)
-                && cmp(addr[1], g_sensors_addr[0], 8)) {
+        else if (cmp_EEPROM(EEPROM_SENSORSID, g_sensors_addr[1], 8)
+                && cmp_EEPROM(EEPROM_SENSORSID + 8, g_sensors_addr[0], 8)) {
             /*  Идентификаторы датчиков соответствуют сохранённым.
                 Но изменён порядок */
             swap(g_sensors_addr[0], g_sensors_addr[1], 8);
@@ -631,6 +694,7 @@ void setup()
     /* Ждём первых результатов от датчиков */
     convertT();
     g_poll_timestamp = millis();
+    g_trend_timestamp = g_poll_timestamp;
     delay750();
 }
 
@@ -726,8 +790,6 @@ void loop()
             if (!g_control_actived) {
                 if (signaled_button == 2) {
                     g_control_actived = true;
-                    update_screen(SETCONTROL);
-                    update_screen(ONOFF);
                     g_blink_timestamp = millis();
                     g_blink_step = 0;
                 }
@@ -747,7 +809,7 @@ void loop()
                 else if (g_control_temp > 1250)
                     g_control_temp = 1250;
 
-                update_screen(SETCONTROL);
+                g_screen_invalid = true;
             
                 EEPROM_write(
                     EEPROM_CONTROL_TEMP_L, g_control_temp & 0xFF);
@@ -760,8 +822,7 @@ void loop()
             if (g_control_actived && signaled_button == 1) {
                 HEATER_OFF();
                 g_control_actived = false;
-                update_screen(ONOFF);
-                update_screen(SETCONTROL);
+                g_screen_invalid = true;
                 g_setcontrol_timestamp = millis();
             }
             else
@@ -770,19 +831,32 @@ void loop()
     } /* if (signaled_button) */
     
     /* Опрос датчиков каждую секунду */
-    if (millis() - g_poll_timestamp > 750) {
+    if (millis() - g_poll_timestamp > POLL_PERIOD) {
         update_temp(SENSOR1);
         update_temp(SENSOR2);
         convertT();
         g_poll_timestamp = millis();
+
+        /*  Отсчёты для трендов берём реже. Метку сдвигаем на период,
+            а не на текущее время, чтобы период в среднем был точным */
+        if (g_poll_timestamp - g_trend_timestamp >= TREND_PERIOD) {
+            g_trend_timestamp += TREND_PERIOD;
+            update_trends();
+        }
+
+        /*  Нагреватель отключается заранее по прогнозу, чтобы
+            температура не "перелетала" заданную. Решение принимаем
+            только при опросе - между опросами данные не меняются */
+        if (g_control_actived && g_control_sensor != NOTHING) {
+            if (g_sensors_trend[g_control_sensor].heat_needed(
+                    g_sensors_temp[g_control_sensor], g_control_temp))
+                HEATER_ON();
+            else
+                HEATER_OFF();
+        }
     }
 
-    if (g_control_actived) {
-        
-        if (g_sensors_temp[g_control_sensor] < g_control_temp)
-            HEATER_ON();
-        else
-            HEATER_OFF();
+    if (g_control_actived && g_control_sensor != NOTHING) {
 
         if (millis() - g_blink_timestamp
                 > (g_blink_step == 0 ? 1000 : 20)) {
@@ -790,11 +864,6 @@ void loop()
 
             if (++g_blink_step >= 30)
                 g_blink_step = 0;
-
-            g_screens_brightness[SENSOR1] =
-            g_screens_brightness[SENSOR2] =
-                g_blink_step <= 15 ?
-                    15 - g_blink_step : g_blink_step - 15;
         }
     }
 
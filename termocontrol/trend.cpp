@@ -0,0 +1,135 @@
+/***********************************************************************
+ *  Оценка тренда температуры (см. trend.h)
+ */
+#include "trend.h"
+
+/* Перевод наклона из десятых градуса за отсчёт в сотые градуса
+ * за минуту: 10 * 60000 / TREND_PERIOD */
+#define TREND_SCALE (600000L / TREND_PERIOD)
+
+/***********************************************************************
+ * Добавление отсчёта
+ * Одиночные ошибки чтения (значение после включения питания, скачки
+ * больше TREND_MAX_STEP) отбрасываются: один такой отсчёт в окне
+ * сильно искажает наклон. Вместо отброшенного отсчёта повторяется
+ * предыдущий, чтобы не нарушать равномерность отсчётов по времени.
+ */
+bool trend_t::add(int16_t temp)
+{
+    if (count_ != 0) {
+        int16_t last = samples_[(head_ + count_ - 1) & (TREND_N - 1)];
+        int16_t step = temp > last ? temp - last : last - temp;
+
+        if (temp == TEMP_POWER_ON) {
+            push(last);
+            return false;
+        }
+
+        if (step > TREND_MAX_STEP) {
+            if (++rejects_ < TREND_MAX_REJECTS) {
+                push(last);
+                return false;
+            }
+
+            /* Скачок подтвердился - старые отсчёты уже не годятся */
+            clear();
+        }
+    }
+    else if (temp == TEMP_POWER_ON)
+        return false;
+
+    rejects_ = 0;
+    push(temp);
+    return true;
+}
+
+/***********************************************************************
+ * Запись отсчёта в окно с пересчётом сумм
+ */
+void trend_t::push(int16_t temp)
+{
+    if (count_ < TREND_N) {
+        /* Окно ещё не заполнено - просто дописываем */
+        samples_[(head_ + count_) & (TREND_N - 1)] = temp;
+        sum_xy_ += (int32_t)count_ * temp;
+        sum_y_ += temp;
+        count_++;
+    }
+    else {
+        /* Сдвигаем окно: самый старый отсчёт заменяется новым */
+        int16_t oldest = samples_[head_];
+        sum_xy_ += (int32_t)(TREND_N - 1) * temp - (sum_y_ - oldest);
+        sum_y_ += temp - oldest;
+        samples_[head_] = temp;
+        head_ = (head_ + 1) & (TREND_N - 1);
+    }
+}
+
+/***********************************************************************
+ * Наклон прямой по методу наименьших квадратов:
+ *      k = (n * Σxy - Σx * Σy) / (n * Σx² - (Σx)²),
+ * где для x = 0..n-1:
+ *      Σx = n(n-1)/2,
+ *      n * Σx² - (Σx)² = n²(n²-1)/12.
+ */
+int16_t trend_t::slope() const
+{
+    if (count_ < 2) return 0;
+
+    int32_t n = count_;
+    int32_t sum_x = n * (n - 1) / 2;
+    int32_t den = n * n * (n * n - 1) / 12;
+    int32_t num = (n * sum_xy_ - sum_x * sum_y_) * TREND_SCALE;
+
+    /* Округляем к ближайшему */
+    return (num + (num < 0 ? -den : den) / 2) / den;
+}
+
+/***********************************************************************
+ * Прогноз температуры линейной экстраполяцией
+ *  temp - текущая температура (десятые доли градуса);
+ *  seconds - на сколько секунд вперёд.
+ */
+int16_t trend_t::predict(int16_t temp, uint16_t seconds) const
+{
+    if (!ready()) return temp;
+
+    /* Сотые доли в минуту -> десятые доли за seconds секунд */
+    return temp + (int32_t)slope() * seconds / 600;
+}
+
+/***********************************************************************
+ * Решение о включении нагревателя
+ * Включаем, как и раньше, только по текущей температуре. Прогноз
+ * используется лишь для досрочного отключения, поэтому ошибочный
+ * наклон не может удерживать нагреватель включенным. После досрочного
+ * отключения включаем снова только с гистерезисом CONTROL_MARGIN.
+ */
+bool trend_t::heat_needed(int16_t temp, int16_t setpoint)
+{
+    if (off_polls_) {
+        off_polls_--;
+        return false;
+    }
+
+    if (temp >= setpoint) {
+        /* Обычное отключение - гистерезис не нужен */
+        cut_off_ = false;
+        return false;
+    }
+
+    int16_t predicted = predict(temp, CONTROL_LOOKAHEAD);
+
+    if (cut_off_) {
+        if (predicted >= setpoint - CONTROL_MARGIN)
+            return false;
+        cut_off_ = false;
+    }
+    else if (predicted >= setpoint) {
+        cut_off_ = true;
+        off_polls_ = CONTROL_MIN_OFF * 1000L / POLL_PERIOD;
+        return false;
+    }
+
+    return true;
+}
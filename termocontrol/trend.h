@@ -0,0 +1,95 @@
+#ifndef TREND_H
+#define TREND_H
+
+#include <stdint.h>
+
+/* Количество отсчётов в окне (степень двойки) */
+#define TREND_N         16
+/* Период отсчётов, мс. Окно: 16 * 6с = 96с */
+#define TREND_PERIOD    6000
+/* Минимальное количество отсчётов для оценки тренда. На коротком
+   окне изменение показаний на 0.1 даёт ложный наклон */
+#define TREND_MIN_COUNT (TREND_N / 2)
+/* Максимальное изменение температуры между отсчётами, десятые доли
+   градуса. Большие скачки считаем ошибкой чтения */
+#define TREND_MAX_STEP  20
+/* Количество отброшенных подряд отсчётов, после которого скачок
+   считаем настоящим и начинаем оценку заново */
+#define TREND_MAX_REJECTS 3
+
+/* Значение DS18B20 после включения питания (85.0), до первой
+   конвертации. Как отсчёт не используется */
+#define TEMP_POWER_ON   850
+
+/* Период опроса датчиков, мс */
+#define POLL_PERIOD     750
+
+/* Инерция нагрева, с: после отключения нагревателя температура
+   продолжает расти примерно столько времени. Нагреватель отключается,
+   когда прогнозируемая на это время вперёд температура достигает
+   заданной */
+#define CONTROL_LOOKAHEAD 120
+
+/* Защита реле от частых переключений после досрочного отключения:
+   нагреватель остаётся выключенным не меньше CONTROL_MIN_OFF секунд
+   и включается снова, только когда прогноз опустится ниже заданной
+   температуры на CONTROL_MARGIN (десятые доли градуса).
+   Пауза считается в опросах (uint8_t), поэтому не больше 190с */
+#define CONTROL_MIN_OFF 120
+#define CONTROL_MARGIN  1
+
+/***********************************************************************
+ * Оценка тренда температуры методом наименьших квадратов в скользящем
+ * окне. Суммы пересчитываются за O(1) на каждый отсчёт, без плавающей
+ * точки.
+ *
+ * Отсчёты - температура в десятых долях градуса (как в g_sensors_temp),
+ * x - номер отсчёта в окне (0 - самый старый). Хранятся суммы:
+ *      sum_y  = Σ y[i]
+ *      sum_xy = Σ i * y[i]
+ * При сдвиге окна (уходит y[0], приходит y_new) номера оставшихся
+ * отсчётов уменьшаются на 1, поэтому:
+ *      sum_xy' = sum_xy - (sum_y - y[0]) + (N - 1) * y_new
+ *      sum_y'  = sum_y - y[0] + y_new
+ */
+class trend_t
+{
+private:
+    int16_t samples_[TREND_N]; /* Кольцевой буфер отсчётов */
+    uint8_t head_ = 0; /* Позиция самого старого отсчёта */
+    uint8_t count_ = 0; /* Количество отсчётов в окне */
+    uint8_t rejects_ = 0; /* Количество отброшенных подряд отсчётов */
+    bool cut_off_ = false; /* Нагреватель отключен досрочно по прогнозу */
+    uint8_t off_polls_ = 0; /* Опросов до конца минимальной паузы */
+    int32_t sum_y_ = 0;
+    int32_t sum_xy_ = 0;
+
+    void push(int16_t temp);
+
+public:
+    void clear()
+    {
+        head_ = count_ = rejects_ = 0;
+        sum_y_ = sum_xy_ = 0;
+    }
+
+    /* Добавление отсчёта. false - отсчёт отброшен как ошибочный */
+    bool add(int16_t temp);
+
+    bool ready() const
+    {
+        return count_ >= TREND_MIN_COUNT;
+    }
+
+    /* Скорость изменения температуры, сотые доли градуса в минуту */
+    int16_t slope() const;
+
+    /* Прогноз температуры через seconds секунд */
+    int16_t predict(int16_t temp, uint16_t seconds) const;
+
+    /* Нужно ли включить нагреватель для поддержания setpoint.
+       Вызывать один раз на каждый опрос датчиков */
+    bool heat_needed(int16_t temp, int16_t setpoint);
+};
+
+#endif /* TREND_H */
@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+#  Отчёт о расходе памяти прошивки: ОЗУ (SRAM) и флеш по символам.
+#  Собирает скетч через arduino-cli и разбирает полученный ELF
+#  утилитами avr-size и avr-nm.
+#
+#  Использование: tools/memreport.sh [FQBN]
+#  По умолчанию FQBN=arduino:avr:pro:cpu=8MHzatmega328 (ATMega328p, 8МГц).
+#
+set -e
+
+FQBN="${1:-${FQBN:-arduino:avr:pro:cpu=8MHzatmega328}}"
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+SKETCH="$ROOT/termocontrol"
+BUILD="${BUILD_DIR:-$ROOT/_memreport}"
+
+arduino-cli compile --fqbn "$FQBN" --output-dir "$BUILD" "$SKETCH" >/dev/null
+ELF="$BUILD/termocontrol.ino.elf"
+
+echo "=== Итого ==="
+avr-size -C --mcu=atmega328p "$ELF"
+
+# Типы символов nm: d/D - .data, b/B - .bss (ОЗУ); t/T - .text,
+# куда попадают и таблицы PROGMEM (флеш). .data занимает и ОЗУ, и флеш
+echo
+echo "=== ОЗУ (.data + .bss), байт ==="
+avr-nm -C -S -t d --size-sort -r "$ELF" | awk '$3 ~ /^[dDbB]$/ { n = $2; t = $3; sub(/^[^ ]+ +[^ ]+ +[^ ]+ +/, ""); printf "%6d  %s  %s\n", n, t, $0 }'
+
+echo
+echo "=== Флеш (.text + PROGMEM), байт ==="
+avr-nm -C -S -t d --size-sort -r "$ELF" | awk '$3 ~ /^[tTrR]$/ { n = $2; t = $3; sub(/^[^ ]+ +[^ ]+ +[^ ]+ +/, ""); printf "%6d  %s  %s\n", n, t, $0 }'
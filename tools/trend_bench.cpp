@@ -0,0 +1,243 @@
+/***********************************************************************
+ *  Проверка оценки тренда и прогнозирующего отключения нагревателя
+ *  на ПК (вне МК). Использует termocontrol/trend.cpp без изменений.
+ *
+ *  Сборка:
+ *      g++ -O2 -I termocontrol -o trend_bench \
+ *          tools/trend_bench.cpp termocontrol/trend.cpp
+ *
+ *  Запуск:
+ *      trend_bench [setpoint]
+ *          - моделирование комнаты с нагревателем; сравнение
+ *            перерегулирования при обычном управлении (по текущей
+ *            температуре) и по прогнозу. setpoint - заданная
+ *            температура, десятые доли градуса (по умолчанию 220);
+ *      trend_bench -r trace.csv [setpoint]
+ *          - воспроизведение записанных показаний датчика: строки
+ *            "мс,температура" (температура в десятых долях градуса,
+ *            как в g_sensors_temp), по строке на опрос. Выводит оценку
+ *            тренда и прогноз и отмечает моменты отключения
+ *            нагревателя обычным управлением (CUT) и по прогнозу
+ *            (PCUT). В конце - насколько раньше отключение по прогнозу
+ *            и перерегулирование в записи после обычного отключения.
+ *            Запись снята без обратной связи от нового управления,
+ *            поэтому уменьшение перерегулирования оценивается по
+ *            выигрышу во времени, а не измеряется напрямую.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "trend.h"
+
+/***********************************************************************
+ *  Модель: нагреватель (с собственной теплоёмкостью, отсюда инерция),
+ *  воздух в комнате, улица. Датчик - с запаздыванием.
+ */
+struct room_t {
+    double heater = 15.0; /* Температура нагревателя, °C */
+    double air = 15.0; /* Температура воздуха, °C */
+    double sensor = 15.0; /* Температура датчика, °C */
+
+    void step(bool on, double dt)
+    {
+        const double power = 1.5; /* кВт */
+        const double c_heater = 30.0; /* кДж/°C */
+        const double c_air = 150.0;
+        const double g_heater_air = 0.1; /* кВт/°C */
+        const double g_air_out = 0.03;
+        const double t_out = 0.0;
+        const double tau_sensor = 30.0; /* с */
+
+        double q_ha = (heater - air) * g_heater_air;
+        double q_ao = (air - t_out) * g_air_out;
+
+        heater += ((on ? power : 0.0) - q_ha) / c_heater * dt;
+        air += (q_ha - q_ao) / c_air * dt;
+        sensor += (air - sensor) / tau_sensor * dt;
+    }
+
+    /* Показание датчика, как его получает update_temp() */
+    int read() const
+    {
+        return (int)lround(sensor * 10.0);
+    }
+};
+
+struct result_t {
+    int max_overshoot; /* Десятые доли градуса */
+    int max_undershoot;
+    double rms; /* °C, после первого достижения заданной */
+    int switches;
+};
+
+/***********************************************************************
+ *  Моделирование работы контроллера в течение hours часов
+ */
+result_t simulate(int setpoint, bool predictive, double hours)
+{
+    room_t room;
+    trend_t trend;
+    result_t res = {0, 0, 0.0, 0};
+
+    const double dt = 0.25;
+    const unsigned long end = (unsigned long)(hours * 3600000.0);
+    unsigned long poll_timestamp = 0;
+    unsigned long trend_timestamp = 0;
+    bool on = false;
+    bool reached = false;
+    double sum_sq = 0.0;
+    unsigned long n = 0;
+
+    for (unsigned long ms = 0; ms < end; ms += (unsigned long)(dt * 1000)) {
+        room.step(on, dt);
+
+        if (ms - poll_timestamp <= POLL_PERIOD) continue;
+        poll_timestamp = ms;
+
+        int temp = room.read();
+
+        if (ms - trend_timestamp >= TREND_PERIOD) {
+            trend_timestamp += TREND_PERIOD;
+            trend.add(temp);
+        }
+
+        /* Обычное управление - как было до оценки тренда */
+        bool new_on = predictive ?
+            trend.heat_needed(temp, setpoint) : temp < setpoint;
+        if (new_on != on) res.switches++;
+        on = new_on;
+
+        /* Качество оцениваем по воздуху, а не по датчику */
+        int air = (int)lround(room.air * 10.0);
+        if (air >= setpoint) reached = true;
+        if (reached) {
+            if (air - setpoint > res.max_overshoot)
+                res.max_overshoot = air - setpoint;
+            if (setpoint - air > res.max_undershoot)
+                res.max_undershoot = setpoint - air;
+            double e = room.air - setpoint / 10.0;
+            sum_sq += e * e;
+            n++;
+        }
+    }
+
+    res.rms = n ? sqrt(sum_sq / n) : 0.0;
+    return res;
+}
+
+/***********************************************************************
+ *  Воспроизведение записанных показаний
+ */
+int replay(const char *filename, int setpoint)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        return 1;
+    }
+
+    trend_t trend;
+    unsigned long trend_timestamp = 0;
+    bool first = true;
+    bool plain_on = false;
+    bool predictive_on = false;
+    bool cut = false; /* Было обычное отключение */
+    unsigned long cut_ms = 0; /* Первое обычное отключение */
+    unsigned long pcut_ms = 0; /* Первое отключение по прогнозу */
+    bool pcut = false;
+    int peak = 0; /* Максимум после первого обычного отключения */
+    char line[128];
+
+    printf("setpoint %d.%d C\n", setpoint / 10, setpoint % 10);
+    printf("%10s %8s %12s %10s %s\n",
+        "ms", "temp", "0.01C/min", "predicted", "mark");
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long ms;
+        int temp;
+        if (sscanf(line, "%lu,%d", &ms, &temp) != 2) continue;
+
+        if (first) {
+            trend_timestamp = ms;
+            first = false;
+        }
+
+        bool sampled = false;
+        if (ms - trend_timestamp >= TREND_PERIOD) {
+            trend_timestamp += TREND_PERIOD;
+            trend.add(temp);
+            sampled = true;
+        }
+
+        /* Те же решения, что принимает прошивка при каждом опросе */
+        bool new_plain_on = temp < setpoint;
+        bool new_predictive_on = trend.heat_needed(temp, setpoint);
+
+        bool plain_cut = plain_on && !new_plain_on;
+        bool predictive_cut = predictive_on && !new_predictive_on;
+
+        if (plain_cut && !cut) {
+            cut = true;
+            cut_ms = ms;
+            peak = temp;
+        }
+        if (predictive_cut && !pcut) {
+            pcut = true;
+            pcut_ms = ms;
+        }
+
+        const char *mark =
+            plain_cut && predictive_cut ? "CUT PCUT" :
+            plain_cut ? "CUT" : predictive_cut ? "PCUT" : "";
+
+        plain_on = new_plain_on;
+        predictive_on = new_predictive_on;
+
+        if (cut && temp > peak) peak = temp;
+
+        if (sampled || *mark)
+            printf("%10lu %8d %12d %10d %s\n", ms, temp, trend.slope(),
+                trend.predict(temp, CONTROL_LOOKAHEAD), mark);
+    }
+
+    fclose(f);
+
+    if (cut) {
+        printf("plain cut-off at %lu ms, overshoot in trace %d.%d C\n",
+            cut_ms, (peak - setpoint) / 10, (peak - setpoint) % 10);
+        if (pcut && pcut_ms <= cut_ms)
+            printf("predictive cut-off at %lu ms, %lu s earlier\n",
+                pcut_ms, (cut_ms - pcut_ms) / 1000);
+        else
+            printf("no predictive cut-off before plain one\n");
+    }
+    else
+        printf("setpoint not reached\n");
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0)
+        return replay(argv[2], argc > 3 ? atoi(argv[3]) : 220);
+
+    int setpoint = argc > 1 ? atoi(argv[1]) : 220;
+
+    printf("setpoint %d.%d C, lookahead %d s, window %d x %d ms\n",
+        setpoint / 10, setpoint % 10, CONTROL_LOOKAHEAD,
+        TREND_N, TREND_PERIOD);
+    printf("%-12s %10s %11s %8s %9s\n",
+        "control", "overshoot", "undershoot", "rms", "switches");
+
+    const char *names[2] = {"current", "predictive"};
+    for (int i = 0; i < 2; i++) {
+        result_t r = simulate(setpoint, i == 1, 6.0);
+        printf("%-12s %8.1f C %9.1f C %6.2f C %9d\n", names[i],
+            r.max_overshoot / 10.0, r.max_undershoot / 10.0,
+            r.rms, r.switches);
+    }
+
+    return 0;
+}